@@ -2,12 +2,517 @@
 #include <amqp_tcp_socket.h>
 #include <iostream>
 #include <string>
-#include <sstream>
+#include <string_view>
 #include <map>
 #include <algorithm>
 #include <vector>
-#include <regex>
-#include <cctype>
+#include <memory>
+#include <memory_resource>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <bit>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WORKER_X86 1
+#else
+#define WORKER_X86 0
+#endif
+
+// bump allocator for per-message scratch data.
+// reset() rewinds it between messages. If a message spilled past the block,
+// the block is grown to fit it, but never beyond max_capacity; bigger
+// messages keep spilling. After shrink_after messages in a row that fit in
+// the initial capacity, the block shrinks back to it.
+class MessageArena : public std::pmr::memory_resource {
+private:
+    struct Spill {
+        void* ptr;
+        size_t bytes;
+        size_t alignment;
+    };
+
+    static constexpr int shrink_after = 64;
+
+    std::unique_ptr<std::byte[]> block;
+    size_t capacity;
+    size_t initial_capacity;
+    size_t max_capacity;
+    size_t offset {0};
+    std::vector<Spill> spills;
+    size_t spilled_bytes {0};
+    int small_messages {0};
+
+    void resize(size_t new_capacity) {
+        capacity = new_capacity;
+        block = std::make_unique_for_overwrite<std::byte[]>(capacity);
+    }
+
+    void releaseSpills() {
+        for (const auto& spill : spills) {
+            std::pmr::new_delete_resource()->deallocate(spill.ptr, spill.bytes, spill.alignment);
+        }
+        spills.clear();
+        spilled_bytes = 0;
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* ptr = block.get() + offset;
+        size_t space = capacity - offset;
+        if (std::align(alignment, bytes, ptr, space)) {
+            offset = capacity - space + bytes;
+            return ptr;
+        }
+        
+        if (spills.size() == spills.capacity()) {
+            spills.reserve(std::max<size_t>(16, spills.size() * 2));
+        }
+        ptr = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        spills.push_back({ptr, bytes, alignment});
+        spilled_bytes += bytes + alignment;
+        return ptr;
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+public:
+    explicit MessageArena(size_t initial_cap = 1 << 20, size_t max_cap = 16 << 20)
+        : block(std::make_unique_for_overwrite<std::byte[]>(initial_cap)), capacity(initial_cap),
+          initial_capacity(initial_cap), max_capacity(std::max(initial_cap, max_cap)) {}
+
+    MessageArena(const MessageArena&) = delete;
+    MessageArena& operator=(const MessageArena&) = delete;
+
+    ~MessageArena() override {
+        releaseSpills();
+    }
+
+    void reset() {
+        size_t used = offset + spilled_bytes;
+        
+        if (!spills.empty()) {
+            releaseSpills();
+            if (capacity < max_capacity) {
+                resize(std::min(max_capacity, std::max(capacity * 2, used)));
+            }
+            small_messages = 0;
+        } else if (capacity > initial_capacity && used <= initial_capacity) {
+            if (++small_messages >= shrink_after) {
+                resize(initial_capacity);
+                small_messages = 0;
+            }
+        } else {
+            small_messages = 0;
+        }
+        offset = 0;
+    }
+};
+
+// byte classification shared by the text kernels.
+// Words are runs of letters (ASCII or UTF-8) that may contain single
+// apostrophes or hyphens between letters. Block classification and ASCII
+// case folding have scalar, SSE4.2 and AVX2 versions; the widest one the
+// CPU supports is picked at startup. Non-ASCII letters known to caseOf are
+// folded by a scalar pass that only runs when the text has non-ASCII bytes.
+class TextClassifier {
+public:
+    enum class Kind { Letter, Joiner, Other };
+    enum class LetterCase { Upper, Lower, None };
+
+    struct Unit {
+        char32_t cp;
+        size_t len;
+        Kind kind;
+    };
+
+private:
+    static constexpr size_t block_size = 32;
+
+    // bit i describes byte i of a block
+    struct BlockMasks {
+        uint32_t letter;
+        uint32_t high;
+        uint32_t joiner;
+    };
+
+    using ClassifyFn = BlockMasks (*)(const unsigned char*);
+    // returns whether src had any non-ASCII bytes
+    using FoldFn = bool (*)(const char*, char*, size_t);
+
+    ClassifyFn classify_block;
+    FoldFn fold_case;
+    const char* level;
+
+    static bool isAsciiLetter(unsigned char c) { return static_cast<unsigned>((c | 0x20) - 'a') < 26; }
+    static bool isAsciiUpper(unsigned char c) { return static_cast<unsigned>(c - 'A') < 26; }
+
+    static BlockMasks classifyScalar(const unsigned char* p) {
+        BlockMasks m {0, 0, 0};
+        for (size_t i = 0; i < block_size; i++) {
+            uint32_t bit = 1u << i;
+            if (isAsciiLetter(p[i])) m.letter |= bit;
+            if (p[i] & 0x80) m.high |= bit;
+            if (p[i] == '\'' || p[i] == '-') m.joiner |= bit;
+        }
+        return m;
+    }
+
+    static bool foldScalar(const char* src, char* dst, size_t n) {
+        unsigned char seen = 0;
+        for (size_t i = 0; i < n; i++) {
+            unsigned char c = src[i];
+            seen |= c;
+            dst[i] = static_cast<char>(isAsciiUpper(c) ? c + 0x20 : c);
+        }
+        return seen & 0x80;
+    }
+
+#if WORKER_X86
+    __attribute__((target("sse4.2")))
+    static void classify16(const unsigned char* p, uint32_t& letter, uint32_t& high, uint32_t& joiner) {
+        const __m128i ranges = _mm_setr_epi8('A', 'Z', 'a', 'z', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i letters = _mm_cmpestrm(ranges, 4, v, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_BIT_MASK);
+        __m128i joiners = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\'')), _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+        letter = static_cast<uint32_t>(_mm_cvtsi128_si32(letters)) & 0xFFFF;
+        high = static_cast<uint32_t>(_mm_movemask_epi8(v));
+        joiner = static_cast<uint32_t>(_mm_movemask_epi8(joiners));
+    }
+
+    __attribute__((target("sse4.2")))
+    static BlockMasks classifySse42(const unsigned char* p) {
+        uint32_t letter_lo, high_lo, joiner_lo, letter_hi, high_hi, joiner_hi;
+        classify16(p, letter_lo, high_lo, joiner_lo);
+        classify16(p + 16, letter_hi, high_hi, joiner_hi);
+        return {letter_lo | (letter_hi << 16), high_lo | (high_hi << 16), joiner_lo | (joiner_hi << 16)};
+    }
+
+    __attribute__((target("sse4.2")))
+    static bool foldSse42(const char* src, char* dst, size_t n) {
+        __m128i seen = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            seen = _mm_or_si128(seen, v);
+            __m128i idx = _mm_sub_epi8(v, _mm_set1_epi8('A'));
+            __m128i upper = _mm_cmpeq_epi8(_mm_min_epu8(idx, _mm_set1_epi8(25)), idx);
+            v = _mm_add_epi8(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+        }
+        return foldScalar(src + i, dst + i, n - i) || _mm_movemask_epi8(seen) != 0;
+    }
+
+    __attribute__((target("avx2")))
+    static BlockMasks classifyAvx2(const unsigned char* p) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i idx = _mm256_sub_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+        __m256i letters = _mm256_cmpeq_epi8(_mm256_min_epu8(idx, _mm256_set1_epi8(25)), idx);
+        __m256i joiners = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\'')),
+                                          _mm256_cmpeq_epi8(v, _mm256_set1_epi8('-')));
+        return {static_cast<uint32_t>(_mm256_movemask_epi8(letters)),
+                static_cast<uint32_t>(_mm256_movemask_epi8(v)),
+                static_cast<uint32_t>(_mm256_movemask_epi8(joiners))};
+    }
+
+    __attribute__((target("avx2")))
+    static bool foldAvx2(const char* src, char* dst, size_t n) {
+        __m256i seen = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            seen = _mm256_or_si256(seen, v);
+            __m256i idx = _mm256_sub_epi8(v, _mm256_set1_epi8('A'));
+            __m256i upper = _mm256_cmpeq_epi8(_mm256_min_epu8(idx, _mm256_set1_epi8(25)), idx);
+            v = _mm256_add_epi8(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+        }
+        return foldScalar(src + i, dst + i, n - i) || _mm256_movemask_epi8(seen) != 0;
+    }
+#endif
+
+    struct Range {
+        char32_t first;
+        char32_t last;
+    };
+
+    // non-ASCII letters and combining marks, sorted and disjoint since isLetter
+    // binary-searches it; digits, punctuation, symbols and anything not listed
+    // are separators. Not covered yet: NKo, Tifinagh, Ol Chiki, Vai and the
+    // historic scripts outside the BMP.
+    static constexpr Range letter_ranges[] = {
+        {0x00AA, 0x00AA}, {0x00B5, 0x00B5}, {0x00BA, 0x00BA},
+        {0x00C0, 0x00D6}, {0x00D8, 0x00F6}, {0x00F8, 0x02C1},           // Latin-1, Latin Extended-A/B, IPA
+        {0x02C6, 0x02D1}, {0x02E0, 0x02E4}, {0x02EC, 0x02EC}, {0x02EE, 0x02EE},
+        {0x0300, 0x0373}, {0x0376, 0x0377}, {0x037B, 0x037D}, {0x037F, 0x037F},   // combining marks, Greek
+        {0x0386, 0x0386}, {0x0388, 0x038A}, {0x038C, 0x038C}, {0x038E, 0x03A1},
+        {0x03A3, 0x03F5}, {0x03F7, 0x0481}, {0x0483, 0x052F},           // Greek, Cyrillic
+        {0x0531, 0x0556}, {0x0559, 0x0559}, {0x0560, 0x0588},           // Armenian
+        {0x0591, 0x05BD}, {0x05BF, 0x05BF}, {0x05C1, 0x05C2}, {0x05C4, 0x05C5},   // Hebrew
+        {0x05C7, 0x05C7}, {0x05D0, 0x05EA}, {0x05EF, 0x05F2},
+        {0x0610, 0x061A}, {0x0620, 0x065F}, {0x066E, 0x06D3}, {0x06D5, 0x06DC},   // Arabic
+        {0x06DF, 0x06E8}, {0x06EA, 0x06EF}, {0x06FA, 0x06FC}, {0x06FF, 0x06FF},
+        {0x0710, 0x074A}, {0x074D, 0x07B1},                             // Syriac, Arabic Supplement, Thaana
+        {0x0900, 0x0963}, {0x0971, 0x097F},                             // Devanagari
+        {0x0980, 0x09E5}, {0x09F0, 0x09F1},                             // Bengali
+        {0x0A00, 0x0A65}, {0x0A70, 0x0A75},                             // Gurmukhi
+        {0x0A80, 0x0AE5}, {0x0AF9, 0x0AFF},                             // Gujarati
+        {0x0B00, 0x0B65}, {0x0B71, 0x0B71},                             // Oriya
+        {0x0B80, 0x0BE5},                                               // Tamil
+        {0x0C00, 0x0C65}, {0x0C80, 0x0CE5},                             // Telugu, Kannada
+        {0x0D00, 0x0D65}, {0x0D7A, 0x0D7F},                             // Malayalam
+        {0x0D80, 0x0DE5}, {0x0DF2, 0x0DF3},                             // Sinhala
+        {0x0E01, 0x0E3A}, {0x0E40, 0x0E4E},                             // Thai
+        {0x0E81, 0x0ECE}, {0x0EDC, 0x0EDF},                             // Lao
+        {0x0F40, 0x0FBC},                                               // Tibetan
+        {0x1000, 0x103F}, {0x1050, 0x108F},                             // Myanmar
+        {0x10A0, 0x10FA}, {0x10FC, 0x10FF},                             // Georgian
+        {0x1100, 0x135A}, {0x13A0, 0x13F5},                             // Hangul Jamo, Ethiopic, Cherokee
+        {0x1780, 0x17D3},                                               // Khmer
+        {0x180B, 0x180D}, {0x1820, 0x1878}, {0x1880, 0x18AA},           // Mongolian
+        {0x1D00, 0x1FBC}, {0x1FBE, 0x1FBE}, {0x1FC2, 0x1FCC},           // phonetic extensions, Latin/Greek Extended
+        {0x1FD0, 0x1FDB}, {0x1FE0, 0x1FEC}, {0x1FF2, 0x1FFC},
+        {0x20D0, 0x20F0},                                               // combining marks for symbols
+        {0x2C00, 0x2CE4},                                               // Glagolitic, Latin Extended-C, Coptic
+        {0x2D00, 0x2D25}, {0x2DE0, 0x2DFF},                             // Georgian Supplement, Cyrillic Extended-A
+        {0x3005, 0x3006}, {0x3031, 0x3035}, {0x3041, 0x3096}, {0x3099, 0x309A},   // kana
+        {0x309D, 0x309F}, {0x30A1, 0x30FA}, {0x30FC, 0x30FF},
+        {0x3105, 0x312F}, {0x3131, 0x318E}, {0x31A0, 0x31BF}, {0x31F0, 0x31FF},   // Bopomofo, Hangul
+        {0x3400, 0x4DBF}, {0x4E00, 0x9FFF}, {0xA000, 0xA48C},           // CJK ideographs, Yi
+        {0xA640, 0xA66F}, {0xA67C, 0xA69F},                             // Cyrillic Extended-B
+        {0xA717, 0xA71F}, {0xA722, 0xA788}, {0xA78B, 0xA7FF},           // Latin Extended-D
+        {0xAC00, 0xD7A3}, {0xD7B0, 0xD7FB},                             // Hangul syllables
+        {0xF900, 0xFAFF},                                               // CJK compatibility ideographs
+        {0xFB00, 0xFB06}, {0xFB13, 0xFB17}, {0xFB1D, 0xFB28}, {0xFB2A, 0xFB4F},   // presentation forms
+        {0xFB50, 0xFD3D}, {0xFD50, 0xFDFB}, {0xFE20, 0xFE2F}, {0xFE70, 0xFEFC},
+        {0xFF21, 0xFF3A}, {0xFF41, 0xFF5A}, {0xFF66, 0xFFDC},           // fullwidth/halfwidth forms
+        {0x20000, 0x3134F},                                             // CJK extensions
+    };
+
+    static_assert([] {
+        for (size_t i = 0; i < std::size(letter_ranges); i++) {
+            if (letter_ranges[i].first > letter_ranges[i].last) return false;
+            if (i > 0 && letter_ranges[i - 1].last >= letter_ranges[i].first) return false;
+        }
+        return true;
+    }(), "letter_ranges must be sorted and disjoint");
+
+    static bool isLetter(char32_t cp) {
+        auto next = std::upper_bound(std::begin(letter_ranges), std::end(letter_ranges), cp,
+                                     [](char32_t c, const Range& r) { return c < r.first; });
+        return next != std::begin(letter_ranges) && cp <= std::prev(next)->last;
+    }
+
+    static Kind kindOf(char32_t cp) {
+        if (cp < 0x80) {
+            if (isAsciiLetter(static_cast<unsigned char>(cp))) return Kind::Letter;
+            if (cp == '\'' || cp == '-') return Kind::Joiner;
+            return Kind::Other;
+        }
+        if (cp == 0x2019 || cp == 0x02BC) return Kind::Joiner;
+        return isLetter(cp) ? Kind::Letter : Kind::Other;
+    }
+
+    // splits a run of letter/joiner/non-ASCII bytes into words
+    template <typename Fn>
+    static void splitRun(std::string_view run, Fn& fn) {
+        size_t word_start = std::string_view::npos;
+        size_t word_end = 0;
+        size_t pos = 0;
+        
+        while (pos < run.size()) {
+            Unit unit = decode(run, pos);
+            bool joined = unit.kind == Kind::Joiner && word_start != std::string_view::npos &&
+                          pos + unit.len < run.size() && decode(run, pos + unit.len).kind == Kind::Letter;
+            
+            if (unit.kind == Kind::Letter) {
+                if (word_start == std::string_view::npos) word_start = pos;
+                word_end = pos + unit.len;
+            } else if (!joined && word_start != std::string_view::npos) {
+                fn(run.substr(word_start, word_end - word_start));
+                word_start = std::string_view::npos;
+            }
+            pos += unit.len;
+        }
+        if (word_start != std::string_view::npos) {
+            fn(run.substr(word_start, word_end - word_start));
+        }
+    }
+
+public:
+    TextClassifier() : classify_block(classifyScalar), fold_case(foldScalar), level("scalar") {
+#if WORKER_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            classify_block = classifyAvx2;
+            fold_case = foldAvx2;
+            level = "avx2";
+        } else if (__builtin_cpu_supports("sse4.2")) {
+            classify_block = classifySse42;
+            fold_case = foldSse42;
+            level = "sse4.2";
+        }
+#endif
+    }
+
+    const char* name() const { return level; }
+
+    // decodes one UTF-8 sequence, malformed bytes come back one at a time as Other
+    static Unit decode(std::string_view text, size_t pos) {
+        unsigned char lead = text[pos];
+        if (lead < 0x80) {
+            return {lead, 1, kindOf(lead)};
+        }
+        
+        size_t len;
+        char32_t cp;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            len = 2;
+            cp = lead & 0x1F;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            len = 3;
+            cp = lead & 0x0F;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            len = 4;
+            cp = lead & 0x07;
+        } else {
+            return {0xFFFD, 1, Kind::Other};
+        }
+        if (pos + len > text.size()) {
+            return {0xFFFD, 1, Kind::Other};
+        }
+        
+        for (size_t i = 1; i < len; i++) {
+            unsigned char c = text[pos + i];
+            if ((c & 0xC0) != 0x80) {
+                return {0xFFFD, 1, Kind::Other};
+            }
+            cp = (cp << 6) | (c & 0x3F);
+        }
+        if ((len == 3 && (cp < 0x800 || (cp >= 0xD800 && cp <= 0xDFFF))) ||
+            (len == 4 && (cp < 0x10000 || cp > 0x10FFFF))) {
+            return {0xFFFD, 1, Kind::Other};
+        }
+        return {cp, len, kindOf(cp)};
+    }
+
+    // covers ASCII, Latin-1, Latin Extended-A, basic Greek (with tonos) and basic Cyrillic
+    static LetterCase caseOf(char32_t cp) {
+        if (cp < 0x80) {
+            if (cp >= 'A' && cp <= 'Z') return LetterCase::Upper;
+            if (cp >= 'a' && cp <= 'z') return LetterCase::Lower;
+            return LetterCase::None;
+        }
+        if (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) return LetterCase::Upper;
+        if (cp >= 0xDF && cp <= 0xFF && cp != 0xF7) return LetterCase::Lower;
+        if (cp >= 0x100 && cp <= 0x17F) {
+            bool odd_upper = (cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17E);
+            if (cp == 0x138 || cp == 0x149 || cp == 0x17F) return LetterCase::Lower;
+            if (cp == 0x178) return LetterCase::Upper;
+            return ((cp & 1) != 0) == odd_upper ? LetterCase::Upper : LetterCase::Lower;
+        }
+        if (cp == 0x386 || (cp >= 0x388 && cp <= 0x38F && cp != 0x38B && cp != 0x38D) ||
+            (cp >= 0x391 && cp <= 0x3AB) || (cp >= 0x400 && cp <= 0x42F)) {
+            return LetterCase::Upper;
+        }
+        if (cp == 0x390 || (cp >= 0x3AC && cp <= 0x3CE) || (cp >= 0x430 && cp <= 0x45F)) return LetterCase::Lower;
+        return LetterCase::None;
+    }
+
+    // lowercase of an uppercase letter known to caseOf; every mapping keeps
+    // the UTF-8 length, so İ (whose lowercase is i + U+0307) is left as is
+    static char32_t toLower(char32_t cp) {
+        if (caseOf(cp) != LetterCase::Upper || cp == 0x130) return cp;
+        if (cp < 0x100) return cp + 0x20;
+        if (cp == 0x178) return 0xFF;
+        if (cp < 0x180) return cp + 1;
+        if (cp == 0x386) return 0x3AC;
+        if (cp == 0x38C) return 0x3CC;
+        if (cp >= 0x388 && cp <= 0x38A) return cp + 0x25;
+        if (cp == 0x38E || cp == 0x38F) return cp + 0x3F;
+        if (cp >= 0x400 && cp <= 0x40F) return cp + 0x50;
+        return cp + 0x20;
+    }
+
+    // writes text lowercased into out, which holds text.size() bytes
+    void foldCase(std::string_view text, char* out) const {
+        if (!fold_case(text.data(), out, text.size())) {
+            return;
+        }
+        
+        std::string_view folded(out, text.size());
+        for (size_t pos = 0; pos < folded.size();) {
+            if (static_cast<unsigned char>(folded[pos]) < 0x80) {
+                pos++;
+                continue;
+            }
+            Unit unit = decode(folded, pos);
+            char32_t lower = toLower(unit.cp);
+            if (lower != unit.cp) {
+                out[pos] = static_cast<char>(0xC0 | (lower >> 6));
+                out[pos + 1] = static_cast<char>(0x80 | (lower & 0x3F));
+            }
+            pos += unit.len;
+        }
+    }
+
+    // calls fn for every word in text
+    template <typename Fn>
+    void forEachWord(std::string_view text, Fn&& fn) const {
+        const auto* data = reinterpret_cast<const unsigned char*>(text.data());
+        size_t run_start = 0;
+        bool in_run = false;
+        bool plain = true;
+        
+        for (size_t base = 0; base < text.size(); base += block_size) {
+            size_t n = std::min(block_size, text.size() - base);
+            BlockMasks m;
+            if (n == block_size) {
+                m = classify_block(data + base);
+            } else {
+                unsigned char tail[block_size] = {};
+                std::memcpy(tail, data + base, n);
+                m = classify_block(tail);
+            }
+            
+            uint32_t word = m.letter | m.high | m.joiner;
+            uint32_t special = m.high | m.joiner;
+            unsigned i = 0;
+            while (i < block_size) {
+                uint32_t from_i = ~0u << i;
+                if (in_run) {
+                    uint32_t ends = ~word & from_i;
+                    uint32_t inside = ends ? from_i & ((ends & (0u - ends)) - 1) : from_i;
+                    if (special & inside) plain = false;
+                    if (!ends) break;
+                    
+                    i = std::countr_zero(ends);
+                    std::string_view run = text.substr(run_start, base + i - run_start);
+                    if (plain) fn(run); else splitRun(run, fn);
+                    in_run = false;
+                } else {
+                    uint32_t starts = word & from_i;
+                    if (!starts) break;
+                    
+                    i = std::countr_zero(starts);
+                    run_start = base + i;
+                    in_run = true;
+                    plain = true;
+                }
+            }
+        }
+        
+        if (in_run) {
+            std::string_view run = text.substr(run_start);
+            if (plain) fn(run); else splitRun(run, fn);
+        }
+    }
+};
 
 class Worker {
 private:
@@ -16,6 +521,10 @@ private:
     std::string result_queue;
     int top_word_count;
     
+    MessageArena arena;
+    std::string result_buffer;
+    TextClassifier classifier;
+    
     std::vector<std::string> positive_words = {
         "good", "great", "excellent", "amazing", "wonderful", "fantastic",
         "happy", "joy", "love", "perfect", "beautiful", "nice", "best",
@@ -65,144 +574,192 @@ public:
         amqp_destroy_connection(conn);
     }
     
+    static bool isGlued(std::string_view text, size_t start, size_t end) {
+        auto glue = [](char c) { return (c >= '0' && c <= '9') || c == '_'; };
+        return (start > 0 && glue(text[start - 1])) || (end < text.size() && glue(text[end]));
+    }
+
+    template <typename T>
+    static void appendNumber(std::string& out, T value) {
+        char buf[32];
+        auto res = std::to_chars(buf, buf + sizeof(buf), value);
+        out.append(buf, res.ptr);
+    }
+
+    // same format as std::to_string(double)
+    static void appendFixed(std::string& out, double value) {
+        char buf[64];
+        auto res = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::fixed, 6);
+        out.append(buf, res.ptr);
+    }
+
     // word counter
-    int countWords(const std::string& text) {
-        std::istringstream iss(text);
+    int countWords(std::string_view text) {
         int count = 0;
-        std::string word;
-        
-        while (iss >> word) {
-            if (!word.empty() && !std::isalpha(word.back())) {
-                word.pop_back();
-            }
-            if (!word.empty() && !std::isalpha(word.front())) {
-                word = word.substr(1);
-            }
-
-            if (!word.empty()) {
-                count++;
-            }
-        }
+        classifier.forEachWord(text, [&](std::string_view) { count++; });
         return count;
     }
     
-    // N top words finder
-    std::string findTopWords(const std::string& text) {
-        std::map<std::string, int> word_count;
-        std::istringstream iss(text);
-        std::string word;
-        
-        while (iss >> word) {
-            word.erase(std::remove_if(word.begin(), word.end(), 
-                                     [](unsigned char c) { return !std::isalpha(c); }), 
-                      word.end());
-            std::transform(word.begin(), word.end(), word.begin(), ::tolower);
-            
-            if (!word.empty()) {
-                word_count[word]++;
-            }
-        }
+    // N top words finder, expects case-folded text
+    void findTopWords(std::string_view folded, std::string& out) {
+        std::pmr::map<std::string_view, int> word_count(&arena);
         
-        std::vector<std::pair<std::string, int>> words(word_count.begin(), word_count.end());
+        classifier.forEachWord(folded, [&](std::string_view word) {
+            word_count[word]++;
+        });
+        
+        std::pmr::vector<std::pair<std::string_view, int>> words(&arena);
+        words.reserve(word_count.size());
+        for (const auto& [w, count] : word_count) {
+            words.emplace_back(w, count);
+        }
         std::sort(words.begin(), words.end(), 
                  [](const auto& a, const auto& b) { return a.second > b.second; });
         
-        std::string result;
         for (int i = 0; i < std::min(top_word_count, (int)words.size()); i++) {
-            if (i > 0) result += ";";
-            result += words[i].first + ":" + std::to_string(words[i].second);
+            if (i > 0) out += ';';
+            out += words[i].first;
+            out += ':';
+            appendNumber(out, words[i].second);
         }
-        
-        return result;
     }
     
-    // sentiment analyzer
-    std::string analyzeSentiment(const std::string& text) {
-        std::istringstream iss(text);
-        std::string word;
+    // sentiment analyzer, expects case-folded text
+    void analyzeSentiment(std::string_view folded, std::string& out) {
         int positive_count = 0;
         int negative_count = 0;
         int total_words = 0;
         
-        while (iss >> word) {
-            word.erase(std::remove_if(word.begin(), word.end(), 
-                                     [](unsigned char c) { return !std::isalpha(c); }), 
-                      word.end());
-            std::transform(word.begin(), word.end(), word.begin(), ::tolower);
-            
-            if (!word.empty()) {
-                total_words++;
-                if (std::find(positive_words.begin(), positive_words.end(), word) != positive_words.end()) {
-                    positive_count++;
-                } else if (std::find(negative_words.begin(), negative_words.end(), word) != negative_words.end()) {
-                    negative_count++;
-                }
+        classifier.forEachWord(folded, [&](std::string_view word) {
+            total_words++;
+            if (std::find(positive_words.begin(), positive_words.end(), word) != positive_words.end()) {
+                positive_count++;
+            } else if (std::find(negative_words.begin(), negative_words.end(), word) != negative_words.end()) {
+                negative_count++;
             }
-        }
+        });
         
-        if (total_words == 0) return "neutral:0";
+        if (total_words == 0) {
+            out += "neutral:0";
+            return;
+        }
         
         double sentiment_score = static_cast<double>(positive_count - negative_count) / total_words;
         
         if (sentiment_score > 0.1) {
-            return "positive:" + std::to_string(sentiment_score);
+            out += "positive:";
         } else if (sentiment_score < -0.1) {
-            return "negative:" + std::to_string(sentiment_score);
+            out += "negative:";
         } else {
-            return "neutral:" + std::to_string(sentiment_score);
+            out += "neutral:";
         }
+        appendFixed(out, sentiment_score);
     }
     
-    // name replacer
-    std::string replaceNames(const std::string& text, const std::string& replacement = "FFFFF") {
-        std::regex name_regex("\\b[A-Z][a-z]+\\b");
-        std::string result = std::regex_replace(text, name_regex, replacement);
+    // name replacer, a name is a capitalized run of letters (Anna, Émile)
+    // between apostrophes/hyphens and not glued to digits or '_'
+    std::pmr::string replaceNames(std::string_view text, std::string_view replacement = "FFFFF") {
+        std::pmr::string result(&arena);
+        result.reserve(text.size());
+        size_t copied = 0;
+        
+        classifier.forEachWord(text, [&](std::string_view word) {
+            size_t word_pos = word.data() - text.data();
+            size_t pos = 0;
+            
+            while (pos < word.size()) {
+                size_t start = pos;
+                size_t letters = 0;
+                bool is_name = true;
+                
+                while (pos < word.size()) {
+                    TextClassifier::Unit unit = TextClassifier::decode(word, pos);
+                    if (unit.kind == TextClassifier::Kind::Joiner) {
+                        break;
+                    }
+                    auto expected = letters == 0 ? TextClassifier::LetterCase::Upper : TextClassifier::LetterCase::Lower;
+                    if (TextClassifier::caseOf(unit.cp) != expected) {
+                        is_name = false;
+                    }
+                    letters++;
+                    pos += unit.len;
+                }
+                
+                if (is_name && letters > 1 && !isGlued(text, word_pos + start, word_pos + pos)) {
+                    result += text.substr(copied, word_pos + start - copied);
+                    result += replacement;
+                    copied = word_pos + pos;
+                }
+                if (pos < word.size()) {
+                    pos += TextClassifier::decode(word, pos).len;
+                }
+            }
+        });
+        
+        result += text.substr(copied);
         return result;
     }
     
     // legnth sentence sorter
-    std::string sortSentencesByLength(const std::string& text) {
-        std::vector<std::string> sentences;
-        std::string current_sentence;
+    void sortSentencesByLength(std::string_view text, std::string& out) {
+        std::pmr::vector<std::string_view> sentences(&arena);
         
-        for (char c : text) {
-            current_sentence += c;
-            if (c == '.' || c == '!' || c == '?') {
-                size_t start = current_sentence.find_first_not_of(" \n\r\t");
-                size_t end = current_sentence.find_last_not_of(" \n\r\t");
-                if (start != std::string::npos && end != std::string::npos) {
-                    std::string clean_sentence = current_sentence.substr(start, end - start + 1);
-                    if (!clean_sentence.empty()) {
-                        sentences.push_back(clean_sentence);
-                    }
-                }
-                current_sentence.clear();
+        auto add_sentence = [&](std::string_view sentence) {
+            size_t start = sentence.find_first_not_of(" \n\r\t");
+            size_t end = sentence.find_last_not_of(" \n\r\t");
+            if (start != std::string_view::npos && end != std::string_view::npos) {
+                sentences.push_back(sentence.substr(start, end - start + 1));
             }
-        }
+        };
         
-        if (!current_sentence.empty()) {
-            size_t start = current_sentence.find_first_not_of(" \n\r\t");
-            size_t end = current_sentence.find_last_not_of(" \n\r\t");
-            if (start != std::string::npos && end != std::string::npos) {
-                std::string clean_sentence = current_sentence.substr(start, end - start + 1);
-                if (!clean_sentence.empty()) {
-                    sentences.push_back(clean_sentence);
-                }
+        size_t sentence_start = 0;
+        for (size_t i = 0; i < text.size(); i++) {
+            char c = text[i];
+            if (c == '.' || c == '!' || c == '?') {
+                add_sentence(text.substr(sentence_start, i - sentence_start + 1));
+                sentence_start = i + 1;
             }
         }
+        add_sentence(text.substr(sentence_start));
         
         std::sort(sentences.begin(), sentences.end(),
-                [](const std::string& a, const std::string& b) {
+                [](std::string_view a, std::string_view b) {
                     return a.length() > b.length();
                 });
         
-        std::string result;
         for (size_t i = 0; i < sentences.size(); i++) {
-            if (i > 0) result += "~";
-            result += sentences[i];
+            if (i > 0) out += '~';
+            out += sentences[i];
         }
+    }
+
+    // serializes the result for one section into result_buffer,
+    // all scratch data lives in the arena and is dropped on the next call
+    void processSection(std::string_view section_id, std::string_view text) {
+        arena.reset();
+        result_buffer.clear();
         
-        return result;
+        std::pmr::string folded(text.size(), '\0', &arena);
+        classifier.foldCase(text, folded.data());
+        std::pmr::string name_replaced = replaceNames(text);
+        
+        result_buffer += section_id;
+        result_buffer += "|words:";
+        appendNumber(result_buffer, countWords(text));
+        result_buffer += "|top:";
+        findTopWords(folded, result_buffer);
+        result_buffer += "|sentiment:";
+        analyzeSentiment(folded, result_buffer);
+        result_buffer += "|names_replaced:";
+        appendNumber(result_buffer, name_replaced.length());
+        result_buffer += "|processed_text:";
+        result_buffer += name_replaced;
+        result_buffer += "|sorted:";
+        sortSentencesByLength(text, result_buffer);
+    }
+
+    const char* textClassification() const {
+        return classifier.name();
     }
 
     void sendResult(const std::string& result) {
@@ -211,9 +768,13 @@ public:
         props.content_type = amqp_cstring_bytes("text/plain");
         props.delivery_mode = 2;
         
+        amqp_bytes_t body;
+        body.len = result.size();
+        body.bytes = const_cast<char*>(result.data());
+        
         amqp_basic_publish(conn, 1, amqp_cstring_bytes(""),
                           amqp_cstring_bytes(result_queue.c_str()), 0, 0,
-                          &props, amqp_cstring_bytes(result.c_str()));
+                          &props, body);
     }
     
     void processMessages() {
@@ -228,31 +789,15 @@ public:
             amqp_rpc_reply_t ret = amqp_consume_message(conn, &envelope, nullptr, 0);
             
             if (ret.reply_type == AMQP_RESPONSE_NORMAL) {
-                std::string message((char*)envelope.message.body.bytes, 
-                                   envelope.message.body.len);
+                std::string_view message(static_cast<const char*>(envelope.message.body.bytes), 
+                                        envelope.message.body.len);
                 
                 size_t pipe_pos = message.find('|');
-                if (pipe_pos != std::string::npos) {
-                    std::string section_id = message.substr(0, pipe_pos);
-                    std::string text = message.substr(pipe_pos + 1);
-                    
-                    int word_count = countWords(text);
-                    std::string top_words = findTopWords(text);
-                    std::string sentiment = analyzeSentiment(text);
-                    std::string name_replaced = replaceNames(text);
-                    std::string sorted_sentences = sortSentencesByLength(text);
-                    
-                    std::string result = 
-                        section_id + "|" +
-                        "words:" + std::to_string(word_count) + "|" +
-                        "top:" + top_words + "|" +
-                        "sentiment:" + sentiment + "|" +
-                        "names_replaced:" + std::to_string(name_replaced.length()) + "|" +
-                        "processed_text:" + name_replaced + "|" +
-                        "sorted:" + sorted_sentences;
+                if (pipe_pos != std::string_view::npos) {
+                    processSection(message.substr(0, pipe_pos), message.substr(pipe_pos + 1));
                     
-                    sendResult(result);
-                    std::cout << "Processed and sent result: " << result << std::endl;
+                    sendResult(result_buffer);
+                    std::cout << "Processed and sent result: " << result_buffer << std::endl;
                 }
                 
                 amqp_destroy_envelope(&envelope);
@@ -266,6 +811,7 @@ int main(int argc, char* argv[]) {
         int top_word_count = std::stoi(argv[1]);
 
         Worker worker("localhost", 5672, top_word_count);
+        std::cout << "Text classification: " << worker.textClassification() << std::endl;
         worker.processMessages();
         
     } catch (const std::exception& e) {